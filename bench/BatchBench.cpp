@@ -0,0 +1,177 @@
+#include "AssemblyLine.h"
+#include <chrono>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Benchmark of a float reduction line, run once with a per job task and once with a batched SIMD task.
+// Each job passes a float that is reduced over a series, the same per element math as task_1 in main.cpp.
+
+const int SERIES_LENGTH = 4000;
+const float SERIES_STEP = 0.0001f;
+
+const int JOBS_PER_LAUNCH = 20000;
+const int LAUNCHES = 10;
+
+// NOTE ->
+//  The bench is built with -ffp-contract=off so the compiler never fuses a multiply and add on its own.
+//  Both modes use a fused multiply add when the host has FMA and a separate multiply and add when it does not,
+//  so each job gets the exact same result in both modes and the results can be checked against each other.
+
+// One job at a time, the series loop can not be vectorized without reordering the float additions.
+float reduceOne(float x)
+{
+    float result = 0.0f;
+
+    for (int k = 0; k < SERIES_LENGTH; k++)
+    {
+#if defined(__FMA__)
+        result = std::fma(x, k * SERIES_STEP, result);
+#else
+        result = result + x * (k * SERIES_STEP);
+#endif
+    }
+
+    return result;
+}
+
+// Many jobs at a time, each SIMD lane is its own job so the math for each job happens in the same order as reduceOne().
+void reduceMany(std::vector<float> &values)
+{
+    size_t i = 0;
+
+#if defined(__AVX512F__)
+    for (; i + 16 <= values.size(); i += 16)
+    {
+        __m512 x = _mm512_loadu_ps(&values[i]);
+        __m512 result = _mm512_setzero_ps();
+
+        for (int k = 0; k < SERIES_LENGTH; k++)
+        {
+#if defined(__FMA__)
+            result = _mm512_fmadd_ps(x, _mm512_set1_ps(k * SERIES_STEP), result);
+#else
+            result = _mm512_add_ps(result, _mm512_mul_ps(x, _mm512_set1_ps(k * SERIES_STEP)));
+#endif
+        }
+
+        _mm512_storeu_ps(&values[i], result);
+    }
+#elif defined(__AVX2__)
+    for (; i + 8 <= values.size(); i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(&values[i]);
+        __m256 result = _mm256_setzero_ps();
+
+        for (int k = 0; k < SERIES_LENGTH; k++)
+        {
+#if defined(__FMA__)
+            result = _mm256_fmadd_ps(x, _mm256_set1_ps(k * SERIES_STEP), result);
+#else
+            result = _mm256_add_ps(result, _mm256_mul_ps(x, _mm256_set1_ps(k * SERIES_STEP)));
+#endif
+        }
+
+        _mm256_storeu_ps(&values[i], result);
+    }
+#endif
+
+    // Remaining jobs that do not fill a full SIMD register.
+    for (; i < values.size(); i++)
+    {
+        values[i] = reduceOne(values[i]);
+    }
+}
+
+// Returns the run time, the results are sorted because the jobs finish in a different order every run.
+double runLine(AssemblyLine &line, int line_id, std::vector<float> &values, double &checksum)
+{
+    SyncResults results;
+    values.clear();
+    checksum = 0.0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int launch = 0; launch < LAUNCHES; launch++)
+    {
+        for (int i = 0; i < JOBS_PER_LAUNCH; i++)
+        {
+            line.AddToBuffer(line_id, float(i % 100) * 0.01f);
+        }
+
+        line.LaunchQueue(results);
+
+        for (int i = 0; i < results[line_id].length; i++)
+        {
+            values.push_back(std::any_cast<float>(results[line_id].data[i]));
+        }
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    std::sort(values.begin(), values.end());
+
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        checksum += values[i];
+    }
+
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main()
+{
+    AssemblyLine line;
+
+    Tasks assembly_line;
+
+    Task per_job = [](int thread_id, std::any &data)
+    {
+        data = reduceOne(std::any_cast<float>(data));
+    };
+
+    assembly_line.push_back(per_job);
+    int per_job_line = line.CreateAssemblyLine(assembly_line);
+
+    Task batched = BatchTask([](int thread_id, Batch &batch)
+    {
+        std::vector<float> values = batch.Gather<float>();
+        reduceMany(values);
+        batch.Scatter(values);
+    }, 256);
+
+    assembly_line.push_back(batched);
+    int batched_line = line.CreateAssemblyLine(assembly_line);
+
+    std::vector<float> per_job_values;
+    std::vector<float> batched_values;
+    double per_job_checksum;
+    double batched_checksum;
+
+    double per_job_ms = runLine(line, per_job_line, per_job_values, per_job_checksum);
+    double batched_ms = runLine(line, batched_line, batched_values, batched_checksum);
+
+    bool match = per_job_values == batched_values;
+
+    int jobs = JOBS_PER_LAUNCH * LAUNCHES;
+
+#if defined(__AVX512F__)
+    const char *simd = "AVX-512";
+#elif defined(__AVX2__)
+    const char *simd = "AVX2";
+#else
+    const char *simd = "none";
+#endif
+
+    printf("Float reduction line, %d jobs, series length %d, SIMD: %s\n", jobs, SERIES_LENGTH, simd);
+    printf("Per job:  %10.2f ms  (%8.0f jobs/s)  checksum %f\n", per_job_ms, jobs / (per_job_ms / 1000.0), per_job_checksum);
+    printf("Batched:  %10.2f ms  (%8.0f jobs/s)  checksum %f\n", batched_ms, jobs / (batched_ms / 1000.0), batched_checksum);
+    printf("Speedup:  %10.2fx\n", per_job_ms / batched_ms);
+    printf("Results match: %s\n", match ? "yes" : "NO");
+
+    return match ? 0 : 1;
+}
@@ -8,6 +8,12 @@
 #include <mutex>
 #include <condition_variable>
 #include <typeinfo>
+#include <sstream>
+#include <atomic>
+#include <chrono>
+#include <cassert>
+
+#include "AssemblyLineTrace.h"
 
 // This is the data type used to create the assemblyLines.
 using Task = std::function<void(int thread_id, std::any &data)>;
@@ -27,9 +33,67 @@ struct Result
     Result() : length(0), data({}) {}
 };
 
+// Passed to batch tasks, holds the data of many queued jobs from the same assembly line and task index.
+struct Batch
+{
+    std::vector<std::any> data; // In queue order, assign back into data[i] to pass it to the next task like a normal task.
+
+    // Copies every job's data into one contiguous list "structure of arrays" so the task can run SIMD math across jobs.
+    template<typename T>
+    std::vector<T> Gather() const
+    {
+        std::vector<T> values;
+        values.reserve(data.size());
+
+        for (size_t i = 0; i < data.size(); i++)
+        {
+            values.push_back(std::any_cast<const T&>(data[i]));
+        }
+
+        return values;
+    }
+
+    // Copies the contiguous list back into each job's data, the reverse of Gather().
+    // IMPORTANT NOTE -> The list must hold exactly one value for each job in the batch.
+    template<typename T>
+    void Scatter(const std::vector<T> &values)
+    {
+        assert(values.size() == data.size());
+
+        for (size_t i = 0; i < data.size(); i++)
+        {
+            data[i] = values[i];
+        }
+    }
+};
+
+using BatchKernel = std::function<void(int thread_id, Batch &batch)>;
+
+// A batch task is placed in a Tasks list like any other task. When a thread grabs one of its jobs it will also grab the
+// jobs for the same assembly line and task index that are waiting directly behind it, up to max_batch_size, and run them in one call.
+struct BatchTask
+{
+    BatchKernel kernel;
+    int max_batch_size;
+
+    BatchTask(BatchKernel batch_kernel, int batch_size = 64) : kernel(std::move(batch_kernel)), max_batch_size(batch_size) {}
+
+    // Runs a batch of one job, this lets a BatchTask be stored as a normal Task.
+    void operator()(int thread_id, std::any &data) const;
+};
+
 using SyncResults = std::vector<Result>;
 using AsyncResults = std::vector<Result>;
 
+// Controls if the workers of a group are allowed to help "lend" themselves to other busy groups.
+// NOTE -> Sync jobs have priority over async jobs, so a lending worker will run other groups sync jobs before its own group's async jobs.
+enum class LendPolicy
+{
+    Never,    // Workers only ever run jobs from there own group, use this for latency critical groups.
+    SyncOnly, // Workers may run other groups sync jobs once there own sync queue is empty, but never other groups async jobs.
+    WhenIdle  // Like SyncOnly, and workers may also run other groups async jobs once both there own queue's are empty.
+};
+
 // Needs to be accessible  befor the class instance is constructed.
 int hardwareThreads();
 
@@ -39,11 +103,20 @@ class AssemblyLine
     AssemblyLine();
     AssemblyLine(int threads);
     
+    int CreateWorkerGroup(const std::string &name, int threads, LendPolicy lend_policy = LendPolicy::WhenIdle);
+    int GetWorkerGroup(const std::string &name);
     int CreateAssemblyLine(std::vector<Task> &assembly_line);
+    int CreateAssemblyLine(std::vector<Task> &assembly_line, int worker_group_id);
     void AddToBuffer(int assembly_line_id, const std::any &data);
     void AddToAsyncBuffer(int assembly_line_id, const std::any &data);
     void LaunchQueue(SyncResults &results);
+    void LaunchQueue(int worker_group_id, SyncResults &results);
     int LaunchAsyncQueue(AsyncResults &results);
+
+    // Scheduler tracing, only records when compiled with ASSEMBLY_LINE_TRACE defined.
+    void StartTrace();
+    void StopTrace();
+    bool WriteTrace(const std::string &path);
     
     // The loging methods need to live in the header file to avoid linker errors when using templates.
     template<typename Log, typename... Logs>
@@ -74,17 +147,25 @@ class AssemblyLine
     ~AssemblyLine();
     
 private:
-    void workerThread(int thread_id);
+    void workerThread(int thread_id, int group_id);
     void waitForWorkersToDie();
+    void spawnWorkers(int group_id, int threads);
 
-    // Helper
-    void wakeSleepingThreads();
+    // Helpers
+    void wakeSleepingThreads(int group_id);
+    void wakeAllSleepingThreads();
+    void notifyGroup(int group_id, bool is_async, int jobs);
+    bool canLend(int lender_id, int group_id, bool is_async);
+    void pushResult(const std::any &data, int line_id, bool is_async);
+    void syncJobDone(int group_id);
+    void traceEvent(int thread_id, TraceEventType type, int group_id = -1, bool is_async = false, int line_id = -1, int task_index = -1, uint32_t job_id = 0, int batch_size = 0);
 
     // Worker thread list, used in the deconstructor to join threads.
     std::vector<std::thread> workers; 
     
     // The list of functions that make up an assembly line.
     std::vector<std::vector<Task>> assembly_lines;
+    std::vector<int> line_groups; // The worker group each assembly line is assigned to, indexed by line id.
     int assembly_line_count; // Used to track the total assembly lines without needing to use a mutex lock.
 
     // The structure used in the queue's
@@ -94,25 +175,42 @@ private:
         int task_index;
         int line_id; // assembly_lines index
         int job_length;
+        uint32_t job_id; // Only used to follow the job through a trace.
     };
 
-    // The deque data type allows for O(1) insertion and deletion from both ends, a vector would require shifting every element leading to O(N).
-    std::deque<Job> sync_queue;
-    std::deque<Job> async_queue;
-    std::deque<Job> sync_buffer; 
-    std::deque<Job> async_buffer;
+    void runBatch(int thread_id, int job_group, bool is_async, Job &first_job, const BatchTask &batch_task, std::unique_lock<std::mutex> &lock);
+
+    // Each worker group owns its own queue's and thread flags, so a burst on one group's lines never queues up in front of another group's lines.
+    struct WorkerGroup
+    {
+        std::string name;
+        LendPolicy lend_policy;
+        int thread_count;
+
+        // The deque data type allows for O(1) insertion and deletion from both ends, a vector would require shifting every element leading to O(N).
+        std::deque<Job> sync_queue;
+        std::deque<Job> async_queue;
+        std::deque<Job> sync_buffer; 
+        std::deque<Job> async_buffer;
+
+        int threads_sleeping;
+        int sync_running; // Sync jobs from this group's queue currently being run by a thread.
+
+        std::condition_variable thread_wake;
+    };
 
-    int thread_count;
+    // Using a deque because it never moves its elements when growing, the condition_variable inside each group can not be moved.
+    std::deque<WorkerGroup> groups;
+
+    int thread_count; // Total threads across every worker group.
 
     // Flags
     bool kill_threads;
-    int threads_sleeping; // Using vector because compile time size is unknown and requires efficient access by index.
     int threads_async;
     int threads_dead;
 
     std::mutex mtx; 
 
-    std::condition_variable thread_wake;
     std::condition_variable thread_is_async;
     std::condition_variable thread_is_dead;
 
@@ -120,4 +218,45 @@ private:
     AsyncResults async_results;
 
     std::vector<std::vector<std::string>> logs;
+
+    // Trace events are added into fixed size chunks, so adding an event never copies the older events.
+    // This matters because some events are recorded while the mutex is held.
+    struct TraceBuffer
+    {
+        static const size_t CHUNK_SIZE = 4096; // 128 KB of events per chunk.
+
+        std::vector<std::vector<TraceEvent>> chunks;
+
+        void Add(const TraceEvent &event)
+        {
+            if (chunks.empty() || chunks.back().size() == CHUNK_SIZE)
+            {
+                // NOTE -> Growing the list of chunks only moves each chunk's pointer, never the events.
+                chunks.emplace_back();
+                chunks.back().reserve(CHUNK_SIZE);
+            }
+
+            chunks.back().push_back(event);
+        }
+
+        size_t Size() const
+        {
+            return chunks.empty() ? 0 : (chunks.size() - 1) * CHUNK_SIZE + chunks.back().size();
+        }
+
+        // Frees the old events and allocates the first chunk so the first events recorded do not allocate.
+        void Reset()
+        {
+            std::vector<std::vector<TraceEvent>>().swap(chunks);
+            chunks.emplace_back();
+            chunks.back().reserve(CHUNK_SIZE);
+        }
+    };
+
+    // Each worker thread owns its own trace buffer by index just like the logs, so recording needs no lock.
+    std::vector<TraceBuffer> traces;
+    TraceBuffer main_trace;
+    std::atomic<bool> tracing;
+    std::chrono::steady_clock::time_point trace_start;
+    uint32_t next_job_id;
 };
\ No newline at end of file
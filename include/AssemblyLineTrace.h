@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+
+// The binary trace format shared by the AssemblyLine and the offline trace_replay tool.
+// Tracing is compiled in only when ASSEMBLY_LINE_TRACE is defined, otherwise recording costs nothing.
+
+// File layout ->
+//  TraceHeader
+//  int32_t group_id for each worker thread "thread_count of them", indexed by thread id.
+//  int32_t LendPolicy value for each worker group "group_count of them", indexed by group id.
+//  TraceEvent for each event "event_count of them", grouped by thread, each thread's events are in time order.
+// NOTE -> Values are written in the byte order of the machine that recorded the trace.
+
+enum class TraceEventType : uint8_t
+{
+    Enqueue,       // Main thread added a job to a buffer.
+    LaunchSync,    // Main thread moved the sync buffers into the queue's "LaunchQueue()", group_id is -1 when every group was launched.
+    SyncDone,      // LaunchQueue() returned, every launched sync job is finished.
+    LaunchAsync,   // Main thread moved the async buffers into the queue's "LaunchAsyncQueue()".
+    Dequeue,       // Worker took a job from a queue, group_id is the group whose queue was used.
+    StageStart,    // Worker started running a task, batch_size is above 1 for jobs run together by a BatchTask.
+    StageEnd,      // Worker finished running a task.
+    Requeue,       // Worker placed the job's next task at the front of the queue.
+    Complete,      // Worker placed the job's data "or a TaskError" into the results.
+    Sleep,         // Worker went to sleep, this also releases the mutex.
+    Wake,          // Worker woke up with work to do, this also acquires the mutex.
+    LockAcquired,  // Worker acquired the mutex.
+    LockReleased   // Worker released the mutex.
+};
+
+struct TraceEvent
+{
+    uint64_t time_ns;    // Nanoseconds since StartTrace().
+    uint32_t job_id;     // Unique per job added to a buffer, 0 when the event has no job.
+    int32_t line_id;
+    int32_t batch_size;
+    int16_t task_index;
+    int16_t thread_id;   // -1 for the main thread.
+    int16_t group_id;
+    TraceEventType type;
+    uint8_t is_async;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(TraceEvent) == 32, "TraceEvent must stay 32 bytes, the trace file format depends on it.");
+
+struct TraceHeader
+{
+    char magic[8];       // "ALTRACE"
+    uint32_t version;
+    uint32_t thread_count;
+    uint32_t group_count;
+    uint32_t reserved;
+    uint64_t event_count;
+};
+
+const char TRACE_MAGIC[8] = "ALTRACE";
+const uint32_t TRACE_VERSION = 2;
@@ -1,21 +1,170 @@
 #include "AssemblyLine.h"
 
+#include <cstdio>
+#include <algorithm>
+
+// The trace macros compile to nothing unless ASSEMBLY_LINE_TRACE is defined, so the untraced build pays no cost.
+#ifdef ASSEMBLY_LINE_TRACE
+#define TRACE(...) do { if (tracing.load(std::memory_order_acquire)) { traceEvent(__VA_ARGS__); } } while (0)
+#else
+#define TRACE(...) do {} while (0)
+#endif
+
+#define TRACE_JOB(thread_id, type, group_id, is_async, job, batch_size) \
+    TRACE(thread_id, type, group_id, is_async, job.line_id, job.task_index, job.job_id, batch_size)
+
 // Not a class function ment to be accessible before the class is created to grab the number of hardware threads.
 int hardwareThreads()
 {
     return std::thread::hardware_concurrency();
 }
 
+void BatchTask::operator()(int thread_id, std::any &data) const
+{
+    Batch batch;
+    batch.data.push_back(std::move(data));
+
+    kernel(thread_id, batch);
+
+    data = std::move(batch.data[0]);
+}
+
 // ----------- Helpers -----------
-void AssemblyLine::wakeSleepingThreads()
+void AssemblyLine::wakeSleepingThreads(int group_id)
 {
-    if (threads_sleeping == 1)
+    WorkerGroup &group = groups[group_id];
+
+    if (group.threads_sleeping == 1)
     {
-        thread_wake.notify_one();
+        group.thread_wake.notify_one();
     }  
-    else if (threads_sleeping <= thread_count)
+    else if (group.threads_sleeping <= group.thread_count)
+    {
+        group.thread_wake.notify_all();
+    }
+}
+
+void AssemblyLine::wakeAllSleepingThreads()
+{
+    for (size_t i = 0; i < groups.size(); i++)
+    {
+        wakeSleepingThreads(i);
+    }
+}
+
+// Wakes one thread for each new job, prefers the group's own threads and only falls back to lending groups threads.
+void AssemblyLine::notifyGroup(int group_id, bool is_async, int jobs)
+{
+    int waking = std::min(jobs, groups[group_id].threads_sleeping);
+
+    for (int i = 0; i < waking; i++)
+    {
+        groups[group_id].thread_wake.notify_one();
+    }
+
+    jobs -= waking;
+
+    for (size_t i = 0; i < groups.size() && jobs > 0; i++)
+    {
+        if (groups[i].threads_sleeping > 0 && canLend(i, group_id, is_async))
+        {
+            waking = std::min(jobs, groups[i].threads_sleeping);
+
+            for (int a = 0; a < waking; a++)
+            {
+                groups[i].thread_wake.notify_one();
+            }
+
+            jobs -= waking;
+        }
+    }
+}
+
+bool AssemblyLine::canLend(int lender_id, int group_id, bool is_async)
+{
+    if (lender_id == group_id)
+    {
+        return false;
+    }
+
+    switch (groups[lender_id].lend_policy)
     {
-        thread_wake.notify_all();
+        case LendPolicy::Never:
+            return false;
+        case LendPolicy::SyncOnly:
+            return !is_async;
+        case LendPolicy::WhenIdle:
+            return true;
+    }
+
+    return false;
+}
+
+// NOTE -> The caller must hold the mutex lock, called once a thread is done with a sync job it took from the group's queue.
+void AssemblyLine::syncJobDone(int group_id)
+{
+    WorkerGroup &group = groups[group_id];
+    group.sync_running--;
+
+    // Used to notify the wait in the per group LaunchQueue().
+    if (group.sync_running == 0 && group.sync_queue.empty())
+    {
+        thread_is_async.notify_one();
+    }
+}
+
+// NOTE -> The caller must hold the mutex lock.
+void AssemblyLine::pushResult(const std::any &data, int line_id, bool is_async)
+{
+    if (!is_async)
+    {
+        sync_results[line_id].data.push_back(data); // NOTE -> push_back() will create its own copy of the passed data so you can pass a reference.
+        sync_results[line_id].length++;
+    }
+    else
+    {
+        async_results[line_id].data.push_back(data);
+        async_results[line_id].length++;
+    }
+}
+
+// A thread_id of -1 records into the main thread's buffer, every other thread only ever writes to its own buffer.
+void AssemblyLine::traceEvent(int thread_id, TraceEventType type, int group_id, bool is_async, int line_id, int task_index, uint32_t job_id, int batch_size)
+{
+    TraceEvent event;
+    event.time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - trace_start).count();
+    event.job_id = job_id;
+    event.line_id = line_id;
+    event.batch_size = batch_size;
+    event.task_index = task_index;
+    event.thread_id = thread_id;
+    event.group_id = group_id;
+    event.type = type;
+    event.is_async = is_async;
+    event.reserved = 0;
+
+    if (thread_id == -1)
+    {
+        main_trace.Add(event);
+    }
+    else
+    {
+        traces[thread_id].Add(event);
+    }
+}
+
+// NOTE -> The caller must hold the mutex lock, the thread id's are global across all groups so they can index the logs.
+void AssemblyLine::spawnWorkers(int group_id, int threads)
+{
+    for (int i = 0; i < threads; i++)
+    {
+        std::vector<std::string> empty = {};
+        logs.push_back(empty);
+        traces.push_back({});
+        std::thread worker(&AssemblyLine::workerThread, this, thread_count, group_id);
+        workers.push_back(std::move(worker)); // moved into a list so they can be joined in the deconstructor.
+        thread_count++;
+        groups[group_id].thread_count++;
     }
 }
 
@@ -28,22 +177,17 @@ AssemblyLine::AssemblyLine()
 
     kill_threads = false;
     threads_async = 0;
-    threads_sleeping = 0;
     threads_dead = 0;
+    thread_count = 0;
+    assembly_line_count = 0;
+    tracing = false;
+    next_job_id = 1;
 
-    thread_count = num_of_threads + 2;
-    
     // TESTING NOTE ->
     //  From the testing i have done i found that creating a thread pool of 2+ the number of hardware threads results in the best average execution speed.
     //  I believe this is do to striking a balance between keeping cores busy and minimizing context switching. More threads tended to slowly reduce execution speeds.
     //  This may not be the case on some machines and will require further testing to gather data.
-    for (int i = 0; i < thread_count; i++)
-    {
-        std::vector<std::string> empty = {};
-        logs.push_back(empty);
-        std::thread worker(&AssemblyLine::workerThread, this, i);
-        workers.push_back(std::move(worker)); // moved into a list so they can be joined in the deconstructor.
-    }
+    CreateWorkerGroup("default", num_of_threads + 2);
 }
 
 // Manual constructor
@@ -51,28 +195,77 @@ AssemblyLine::AssemblyLine(int threads)
 {
     kill_threads = false;
     threads_async = 0;
-    threads_sleeping = 0;
     threads_dead = 0;
+    thread_count = 0;
+    assembly_line_count = 0;
+    tracing = false;
+    next_job_id = 1;
 
-    thread_count = threads;
+    CreateWorkerGroup("default", threads);
+}
 
-    for (int i = 0; i < threads; i++)
+// Creates a new group of worker threads with its own job queue's, returns the group's index "ID".
+// IMPORTANT NOTE -> Worker groups must be created before launching any queue's, the logs are not locked while threads are running.
+int AssemblyLine::CreateWorkerGroup(const std::string &name, int threads, LendPolicy lend_policy)
+{
+    if (threads <= 0)
     {
-        std::vector<std::string> empty = {};
-        logs.push_back(empty);
-        std::thread worker(&AssemblyLine::workerThread, this, i);
-        workers.push_back(std::move(worker));
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock(mtx);
+
+    groups.emplace_back();
+    int group_id = groups.size() - 1;
+
+    WorkerGroup &group = groups[group_id];
+    group.name = name;
+    group.lend_policy = lend_policy;
+    group.thread_count = 0;
+    group.threads_sleeping = 0;
+    group.sync_running = 0;
+
+    spawnWorkers(group_id, threads);
+
+    return group_id;
+}
+
+// Returns the worker group's index "ID" by name, or -1 if no group has that name.
+int AssemblyLine::GetWorkerGroup(const std::string &name)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+
+    for (size_t i = 0; i < groups.size(); i++)
+    {
+        if (groups[i].name == name)
+        {
+            return i;
+        }
     }
+
+    return -1;
 }
 
 int AssemblyLine::CreateAssemblyLine(std::vector<Task> &assembly_line)
+{
+    // Lines without a group are assigned to the default group created by the constructor.
+    return CreateAssemblyLine(assembly_line, 0);
+}
+
+int AssemblyLine::CreateAssemblyLine(std::vector<Task> &assembly_line, int worker_group_id)
 {
     std::lock_guard<std::mutex> lock(mtx); // locking just incase user adds assembly lines after queue launch.
 
+    if (worker_group_id < 0 || worker_group_id >= (int)groups.size())
+    {
+        return -1;
+    }
+
     Result result;
     sync_results.push_back(result);
     async_results.push_back(result);
     assembly_lines.push_back(assembly_line);
+    line_groups.push_back(worker_group_id);
     assembly_line_count++;
     Tasks empty;
     assembly_line.swap(empty);
@@ -87,8 +280,11 @@ void AssemblyLine::AddToBuffer(int assembly_line_id, const std::any &data)
     job.line_id = assembly_line_id;
     job.task_index = 0;
     job.job_length = assembly_lines[assembly_line_id].size();
+    job.job_id = next_job_id++;
 
-    sync_buffer.push_back(job); // add jobs to the back of the queue fallowing FIFO "first in first out"
+    TRACE_JOB(-1, TraceEventType::Enqueue, line_groups[assembly_line_id], false, job, 0);
+
+    groups[line_groups[assembly_line_id]].sync_buffer.push_back(job); // add jobs to the back of the queue fallowing FIFO "first in first out"
 }
 
 void AssemblyLine::AddToAsyncBuffer(int assembly_line_id, const std::any &data)
@@ -98,8 +294,11 @@ void AssemblyLine::AddToAsyncBuffer(int assembly_line_id, const std::any &data)
     job.line_id = assembly_line_id;
     job.task_index = 0;
     job.job_length = assembly_lines[assembly_line_id].size();
+    job.job_id = next_job_id++;
+
+    TRACE_JOB(-1, TraceEventType::Enqueue, line_groups[assembly_line_id], true, job, 0);
 
-    async_buffer.push_back(job);
+    groups[line_groups[assembly_line_id]].async_buffer.push_back(job);
 }
 
 void AssemblyLine::LaunchQueue(SyncResults &results)
@@ -120,26 +319,82 @@ void AssemblyLine::LaunchQueue(SyncResults &results)
     std::unique_lock<std::mutex> lock(mtx); 
 
     // .swap() is much faster than .insert() and can be done because the sync_queue is guaranteed to be empty upon calling this method.
-    sync_queue.swap(sync_buffer);  
+    for (size_t i = 0; i < groups.size(); i++)
+    {
+        groups[i].sync_queue.swap(groups[i].sync_buffer);
+    }
 
     // NOTE -> no need to clear the buffer as it has bean swapped with an empty deque.
 
-    wakeSleepingThreads();
+    TRACE(-1, TraceEventType::LaunchSync);
+
+    wakeAllSleepingThreads();
 
     // Wait for sync jobs to finish.
     thread_is_async.wait(lock, [&] {
-        if (threads_async == thread_count && sync_queue.empty())
+        if (threads_async != thread_count)
         {
-            return true;
+            return false;
         }
 
-        return false;
+        for (size_t i = 0; i < groups.size(); i++)
+        {
+            if (!groups[i].sync_queue.empty())
+            {
+                return false;
+            }
+        }
+
+        return true;
     });
 
+    TRACE(-1, TraceEventType::SyncDone);
+
     // After waiting update the results.
     results.swap(sync_results);  
 }
 
+// Launches only one worker group's synchronous buffer and waits only for that group's jobs, so a critical group's
+// results are returned without waiting behind the other groups. The results only hold that group's assembly lines.
+void AssemblyLine::LaunchQueue(int worker_group_id, SyncResults &results)
+{
+    if (!results.empty())
+    {
+        SyncResults().swap(results);
+    }
+
+    for (int i = 0; i < assembly_line_count; i++) {
+        Result default_result;
+        results.push_back(default_result);
+    }
+
+    std::unique_lock<std::mutex> lock(mtx); 
+
+    // Nothing is launched for an unknown group, the results are left as the empty defaults.
+    if (worker_group_id < 0 || worker_group_id >= (int)groups.size())
+    {
+        return;
+    }
+
+    WorkerGroup &group = groups[worker_group_id];
+
+    group.sync_queue.swap(group.sync_buffer);
+
+    TRACE(-1, TraceEventType::LaunchSync, worker_group_id);
+
+    // Waking every group so lending threads can help as well.
+    wakeAllSleepingThreads();
+
+    // Jobs taken by a thread are still running until sync_running is back to 0, the queue alone becomes empty to soon.
+    thread_is_async.wait(lock, [&] {
+        return group.sync_queue.empty() && group.sync_running == 0;
+    });
+
+    TRACE(-1, TraceEventType::SyncDone, worker_group_id);
+
+    results.swap(sync_results);  
+}
+
 int AssemblyLine::LaunchAsyncQueue(AsyncResults &results)
 {
     if (!results.empty())
@@ -154,27 +409,158 @@ int AssemblyLine::LaunchAsyncQueue(AsyncResults &results)
 
     std::lock_guard<std::mutex> lock(mtx);
 
-    if (!async_buffer.empty())
+    int queue_size = 0;
+
+    for (size_t i = 0; i < groups.size(); i++)
     {
-        // Cannot use swap() for the async buffer as new jobs may be added before the queue is empty.
-        async_queue.insert(
-            async_queue.end(),
-            std::make_move_iterator(async_buffer.begin()), // make_move_iterator() makes the insert much more efficient.
-            std::make_move_iterator(async_buffer.end()) 
-        );
-        
-        std::deque<Job> empty; // Creating a empty deque 
-        async_buffer.swap(empty); // Using swap() instead of clear() because it is more efficient.
+        WorkerGroup &group = groups[i];
+
+        if (!group.async_buffer.empty())
+        {
+            // Cannot use swap() for the async buffer as new jobs may be added before the queue is empty.
+            group.async_queue.insert(
+                group.async_queue.end(),
+                std::make_move_iterator(group.async_buffer.begin()), // make_move_iterator() makes the insert much more efficient.
+                std::make_move_iterator(group.async_buffer.end()) 
+            );
+            
+            std::deque<Job> empty; // Creating a empty deque 
+            group.async_buffer.swap(empty); // Using swap() instead of clear() because it is more efficient.
+        }
+
+        queue_size += group.async_queue.size();
     }
 
-    if (!async_queue.empty())
+    TRACE(-1, TraceEventType::LaunchAsync, -1, true);
+
+    if (queue_size > 0)
     {
-        wakeSleepingThreads();
+        wakeAllSleepingThreads();
     }
 
     results.swap(async_results);
 
-    return async_queue.size();
+    return queue_size;
+}
+
+// Clears any old trace and starts recording, each trace buffer gets its first chunk up front so the first events recorded do not allocate.
+// Does nothing when a trace is already being recorded, call StopTrace() first.
+// NOTE -> The trace methods do nothing unless compiled with ASSEMBLY_LINE_TRACE defined.
+void AssemblyLine::StartTrace()
+{
+#ifdef ASSEMBLY_LINE_TRACE
+    std::lock_guard<std::mutex> lock(mtx);
+
+    // The worker threads may still be writing to the buffers, so they can only be cleared once StopTrace() has returned.
+    if (tracing)
+    {
+        return;
+    }
+
+    main_trace.Reset();
+
+    for (size_t i = 0; i < traces.size(); i++)
+    {
+        traces[i].Reset();
+    }
+
+    trace_start = std::chrono::steady_clock::now();
+    tracing = true;
+#endif
+}
+
+// Waits until every queue is empty and every worker thread is asleep before it stops recording.
+// The worker threads write to there trace buffers without a lock, so this is what makes it safe for WriteTrace() to read them.
+// IMPORTANT NOTE -> This blocks until all of the queued jobs are done, jobs still in the buffers are not waited on.
+void AssemblyLine::StopTrace()
+{
+#ifdef ASSEMBLY_LINE_TRACE
+    std::unique_lock<std::mutex> lock(mtx);
+
+    thread_is_async.wait(lock, [&] {
+        int threads_sleeping = 0;
+
+        for (size_t i = 0; i < groups.size(); i++)
+        {
+            if (!groups[i].sync_queue.empty() || !groups[i].async_queue.empty())
+            {
+                return false;
+            }
+
+            threads_sleeping += groups[i].threads_sleeping;
+        }
+
+        return threads_sleeping == thread_count;
+    });
+
+    tracing = false;
+#endif
+}
+
+// Writes the recorded trace to a binary file that can be read by the trace_replay tool, returns false if nothing could be written.
+// IMPORTANT NOTE -> Call this after StopTrace().
+bool AssemblyLine::WriteTrace(const std::string &path)
+{
+#ifndef ASSEMBLY_LINE_TRACE
+    (void)path;
+    return false;
+#else
+    std::lock_guard<std::mutex> lock(mtx);
+
+    FILE *file = fopen(path.c_str(), "wb");
+
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    TraceHeader header;
+    std::copy(TRACE_MAGIC, TRACE_MAGIC + 8, header.magic);
+    header.version = TRACE_VERSION;
+    header.thread_count = thread_count;
+    header.group_count = groups.size();
+    header.reserved = 0;
+    header.event_count = main_trace.Size();
+
+    for (size_t i = 0; i < traces.size(); i++)
+    {
+        header.event_count += traces[i].Size();
+    }
+
+    fwrite(&header, sizeof(header), 1, file);
+
+    // The group of each worker thread, so the tool knows how the pool was split up.
+    for (size_t i = 0; i < groups.size(); i++)
+    {
+        for (int a = 0; a < groups[i].thread_count; a++)
+        {
+            int32_t group_id = i;
+            fwrite(&group_id, sizeof(group_id), 1, file);
+        }
+    }
+
+    // The lend policy of each group, so the tool can replay threads helping other groups.
+    for (size_t i = 0; i < groups.size(); i++)
+    {
+        int32_t lend_policy = (int32_t)groups[i].lend_policy;
+        fwrite(&lend_policy, sizeof(lend_policy), 1, file);
+    }
+
+    for (const std::vector<TraceEvent> &chunk : main_trace.chunks)
+    {
+        fwrite(chunk.data(), sizeof(TraceEvent), chunk.size(), file);
+    }
+
+    for (size_t i = 0; i < traces.size(); i++)
+    {
+        for (const std::vector<TraceEvent> &chunk : traces[i].chunks)
+        {
+            fwrite(chunk.data(), sizeof(TraceEvent), chunk.size(), file);
+        }
+    }
+
+    return fclose(file) == 0;
+#endif
 }
 
 // Deconstructor 
@@ -199,7 +585,7 @@ void AssemblyLine::waitForWorkersToDie()
     // Flag used to break the worker threads wile loop so they can be joined.
     kill_threads = true;
 
-    wakeSleepingThreads();
+    wakeAllSleepingThreads();
 
     // Waits for all threads to break ther wile loop.
     thread_is_dead.wait(lock, [&] { 
@@ -214,27 +600,147 @@ void AssemblyLine::waitForWorkersToDie()
 
 // -------------- WORKER THREAD CODE --------------
 
+// Called by a worker thread with the mutex locked, the lock is held again when this returns.
+// NOTE -> 
+//  Only the jobs waiting directly behind the first job are grabbed, so the batch never waits on jobs that have not arrived yet
+//  and the FIFO order of the queue is kept. When the queue is short the batch is just smaller, keeping latency the same as a normal task.
+void AssemblyLine::runBatch(int thread_id, int job_group, bool is_async, Job &first_job, const BatchTask &batch_task, std::unique_lock<std::mutex> &lock)
+{
+    std::deque<Job> &queue = is_async ? groups[job_group].async_queue : groups[job_group].sync_queue;
+
+    std::vector<Job> jobs;
+    jobs.reserve(std::min<size_t>(batch_task.max_batch_size, queue.size() + 1)); // Only the jobs actually waiting, max_batch_size may be very large.
+    jobs.push_back(std::move(first_job));
+
+    while (!queue.empty() && (int)jobs.size() < batch_task.max_batch_size)
+    {
+        Job &next = queue.front();
+
+        if (next.line_id != jobs[0].line_id || next.task_index != jobs[0].task_index)
+        {
+            break;
+        }
+
+        TRACE_JOB(thread_id, TraceEventType::Dequeue, job_group, is_async, next, 0);
+
+        jobs.push_back(std::move(next));
+        queue.pop_front();
+    }
+
+    TRACE(thread_id, TraceEventType::LockReleased);
+    lock.unlock();
+
+    Batch batch;
+    batch.data.reserve(jobs.size());
+
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        batch.data.push_back(std::move(jobs[i].data));
+    }
+
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        TRACE_JOB(thread_id, TraceEventType::StageStart, job_group, is_async, jobs[i], jobs.size());
+    }
+
+    batch_task.kernel(thread_id, batch);
+
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        TRACE_JOB(thread_id, TraceEventType::StageEnd, job_group, is_async, jobs[i], jobs.size());
+    }
+
+    // Jobs with a next task are collected so they can be placed at the front of the queue in the same order they were taken.
+    std::vector<Job> next_jobs;
+
+    lock.lock();
+    TRACE(thread_id, TraceEventType::LockAcquired);
+
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        Job &job = jobs[i];
+        job.data = std::move(batch.data[i]);
+
+        if (job.data.type() == typeid(TaskError))
+        {
+            TaskError &error = std::any_cast<TaskError&>(job.data);
+            error.task_index = job.task_index;
+
+            pushResult(job.data, job.line_id, is_async);
+            TRACE_JOB(thread_id, TraceEventType::Complete, job_group, is_async, job, 0);
+        }
+        else if (job.job_length - 1 > job.task_index)
+        {
+            job.task_index++;
+            TRACE_JOB(thread_id, TraceEventType::Requeue, job_group, is_async, job, 0);
+            next_jobs.push_back(std::move(job));
+        }
+        else
+        {
+            pushResult(job.data, job.line_id, is_async);
+            TRACE_JOB(thread_id, TraceEventType::Complete, job_group, is_async, job, 0);
+        }
+    }
+
+    if (!next_jobs.empty())
+    {
+        queue.insert(
+            queue.begin(),
+            std::make_move_iterator(next_jobs.begin()),
+            std::make_move_iterator(next_jobs.end())
+        );
+
+        // Every job of the batch can run its next task at the same time, so wake a thread for each one.
+        notifyGroup(job_group, is_async, next_jobs.size());
+    }
+}
+
 // IMPORTANT NOTES -> 
 //  The threads use cooperative yielding to avoid any cpu idle time during transitions from sync and async.
 //  The sync_queue has priority in this system and will run until empty before using the async_queue.
+//  Each thread belongs to one worker group, if the group's LendPolicy allows it the thread picks work in this order:
+//  its own sync queue, other groups sync queue's, its own async queue, and last other groups async queue's.
 //  Int flags are used to share the state of each worker thread to the main thread.
-void AssemblyLine::workerThread(int thread_id)
+void AssemblyLine::workerThread(int thread_id, int group_id)
 {
     bool is_async = false;
     bool sleeping = false;
+    int job_group = group_id; // The group whose queue the current job was taken from.
 
     while (true)
     {
         std::unique_lock<std::mutex> lock(mtx);
+        TRACE(thread_id, TraceEventType::LockAcquired);
+
+        WorkerGroup &home = groups[group_id];
 
-        // Will wait "sleep" once both queue's are empty.
-        thread_wake.wait(lock, [&] {
+        // Will wait "sleep" once every queue this thread is allowed to run is empty.
+        home.thread_wake.wait(lock, [&] {
             // kill_threads is used to break the while loop so the thread can be joined in the deconstruction of the class.
             if (kill_threads)
             {
                 return true;
             }
-            else if (!sync_queue.empty())
+
+            job_group = -1;
+
+            if (!home.sync_queue.empty())
+            {
+                job_group = group_id;
+            }
+            else
+            {
+                for (size_t i = 0; i < groups.size(); i++)
+                {
+                    if (!groups[i].sync_queue.empty() && canLend(group_id, i, false))
+                    {
+                        job_group = i;
+                        break;
+                    }
+                }
+            }
+
+            if (job_group != -1)
             { 
                 if (is_async)
                 {
@@ -245,7 +751,8 @@ void AssemblyLine::workerThread(int thread_id)
                 if (sleeping)
                 {
                     sleeping = false;
-                    threads_sleeping--;
+                    home.threads_sleeping--;
+                    TRACE(thread_id, TraceEventType::Wake, group_id);
                 }
 
                 return true;
@@ -261,12 +768,34 @@ void AssemblyLine::workerThread(int thread_id)
                     thread_is_async.notify_one(); 
                 }
 
-                if (async_queue.empty())
+                if (!home.async_queue.empty())
+                {
+                    job_group = group_id;
+                }
+                else
+                {
+                    for (size_t i = 0; i < groups.size(); i++)
+                    {
+                        if (!groups[i].async_queue.empty() && canLend(group_id, i, true))
+                        {
+                            job_group = i;
+                            break;
+                        }
+                    }
+                }
+
+                if (job_group == -1)
                 {
                     if (!sleeping)
                     {
                         sleeping = true;
-                        threads_sleeping++;
+                        home.threads_sleeping++;
+                        TRACE(thread_id, TraceEventType::Sleep, group_id, true);
+
+#ifdef ASSEMBLY_LINE_TRACE
+                        // Used to notify the wait in StopTrace() that waits for every thread to be asleep.
+                        thread_is_async.notify_one();
+#endif
                     }
                     return false;
                 }
@@ -275,7 +804,8 @@ void AssemblyLine::workerThread(int thread_id)
                     if (sleeping)
                     {
                         sleeping = false;
-                        threads_sleeping--;
+                        home.threads_sleeping--;
+                        TRACE(thread_id, TraceEventType::Wake, group_id, true);
                     }
                     return true;
                 }
@@ -288,26 +818,57 @@ void AssemblyLine::workerThread(int thread_id)
             break;
         }
 
+        WorkerGroup &group = groups[job_group];
+
         // Grab the task from the end of the respective queue and remove it.
         Job job;
 
         if (!is_async)
         {
-            job = sync_queue.front();
-            sync_queue.pop_front();
+            job = group.sync_queue.front();
+            group.sync_queue.pop_front();
         }
         else
         {
-            job = async_queue.front();
-            async_queue.pop_front();
+            job = group.async_queue.front();
+            group.async_queue.pop_front();
+        }
+
+        TRACE_JOB(thread_id, TraceEventType::Dequeue, job_group, is_async, job, 0);
+
+        if (!is_async)
+        {
+            group.sync_running++;
         }
 
         Task task = assembly_lines[job.line_id][job.task_index]; // Grabbing the actual function from the assembly_lines.
+
+        // Batch tasks take over the rest of the job's processing, including posting the next jobs.
+        const BatchTask *batch_task = task.target<BatchTask>();
+
+        if (batch_task != nullptr && batch_task->max_batch_size > 1)
+        {
+            runBatch(thread_id, job_group, is_async, job, *batch_task, lock);
+
+            if (!is_async)
+            {
+                syncJobDone(job_group);
+            }
+
+            TRACE(thread_id, TraceEventType::LockReleased);
+            lock.unlock();
+            continue;
+        }
         
+        TRACE(thread_id, TraceEventType::LockReleased);
         lock.unlock(); // Unlock the mutex. 
 
+        TRACE_JOB(thread_id, TraceEventType::StageStart, job_group, is_async, job, 1);
+
         task(thread_id, job.data);
 
+        TRACE_JOB(thread_id, TraceEventType::StageEnd, job_group, is_async, job, 1);
+
         // NOTE -> 
         //  job.data is passed by reference so no need to return anything. 
         //  This is more efficient in the event of larger peaces of data being passed.
@@ -320,17 +881,10 @@ void AssemblyLine::workerThread(int thread_id)
             error.task_index = job.task_index;
 
             lock.lock();
+            TRACE(thread_id, TraceEventType::LockAcquired);
+            TRACE_JOB(thread_id, TraceEventType::Complete, job_group, is_async, job, 0);
 
-            if (!is_async)
-            {
-                sync_results[job.line_id].data.push_back(job.data); // NOTE -> push_back() will create its own copy of the passed data so you can pass a reference.
-                sync_results[job.line_id].length++;
-            }
-            else
-            {
-                async_results[job.line_id].data.push_back(job.data);
-                async_results[job.line_id].length++;
-            }
+            pushResult(job.data, job.line_id, is_async);
 
             // NOTE -> In the event of a error no next job is posted into the queue.
         } 
@@ -344,15 +898,17 @@ void AssemblyLine::workerThread(int thread_id)
     
                 // Must lock the mutex again before accessing a queue
                 lock.lock();
+                TRACE(thread_id, TraceEventType::LockAcquired);
+                TRACE_JOB(thread_id, TraceEventType::Requeue, job_group, is_async, job, 0);
     
                 // NOTE -> Adding the next job to the front of the queue to fallow FIFO "first in first out" of each assembly line.
                 if (!is_async) 
                 {
-                    sync_queue.push_front(job); 
+                    group.sync_queue.push_front(job); 
                 }
                 else
                 {
-                    async_queue.push_front(job);
+                    group.async_queue.push_front(job);
                 }
     
                 //NOTE -> 
@@ -360,25 +916,25 @@ void AssemblyLine::workerThread(int thread_id)
                 //  If this occurs and the opposing queue is also empty a thread may get put to sleep to soon,
                 //  leading to cpu idle time. From my testing this dose indead bring threads back in this event,
                 //  preventing threads from being put to sleep to soon.
-                thread_wake.notify_one(); 
+                notifyGroup(job_group, is_async, 1); 
             } 
             else
             {
                 // If there is not next job copy over the resulting data into the results.
                 lock.lock();
+                TRACE(thread_id, TraceEventType::LockAcquired);
+                TRACE_JOB(thread_id, TraceEventType::Complete, job_group, is_async, job, 0);
     
-                if (!is_async)
-                {
-                    sync_results[job.line_id].data.push_back(job.data);
-                    sync_results[job.line_id].length++;
-                }
-                else
-                {
-                    async_results[job.line_id].data.push_back(job.data);
-                    async_results[job.line_id].length++;
-                }
+                pushResult(job.data, job.line_id, is_async);
             }
         }
+
+        if (!is_async)
+        {
+            syncJobDone(job_group);
+        }
+
+        TRACE(thread_id, TraceEventType::LockReleased);
         lock.unlock();
 
     } // End of the while loop.
@@ -23,6 +23,9 @@ void test(int threads)
 {
     AssemblyLine line(threads);
 
+    // Giving the light test line its own threads so it is never stuck behind the heavy task_1 jobs.
+    int criticalGroup = line.CreateWorkerGroup("critical", 2, LendPolicy::Never);
+
     Tasks assemblyLine;
 
     
@@ -142,12 +145,16 @@ void test(int threads)
 
     assemblyLine.push_back(test_2);
 
-    int testID = line.CreateAssemblyLine(assemblyLine);
+    int testID = line.CreateAssemblyLine(assemblyLine, criticalGroup);
     
     assemblyLine.clear();
 
     std::string hello = "hello";
 
+    // Only records when built with "make trace", otherwise these calls do nothing.
+    // Started before any jobs are added so every job's enqueue is in the trace.
+    line.StartTrace();
+
     for (int i = 0; i < 300000; i++)
     {
         // line.AddToAsyncBuffer(piplineID, NULL);
@@ -155,6 +162,7 @@ void test(int threads)
         // line.AddToAsyncBuffer(testID, hello);
     }
     
+    SyncResults critical_results;
     SyncResults sync_results;
     AsyncResults async_results;
     while (true)
@@ -168,6 +176,7 @@ void test(int threads)
             line.AddToBuffer(testID, std::string("hello"));
         }
         
+        line.LaunchQueue(criticalGroup, critical_results); // only waits for the critical group's jobs, not the heavy task_1 jobs.
         line.LaunchQueue(sync_results); // this will wait until all threads are async and the sync queue is empty.
         int size = line.LaunchAsyncQueue(async_results); // this will add to the async queue but will wait to run it until the sync queue is done.
 
@@ -188,9 +197,9 @@ void test(int threads)
                 // printf("Sync Result: %f\n", result);
             }
         }
-        for (size_t i = 0; i < sync_results[testID].length; i++)
+        for (size_t i = 0; i < critical_results[testID].length; i++)
         {
-            std::string result = std::any_cast<std::string>(sync_results[testID].data[i]);
+            std::string result = std::any_cast<std::string>(critical_results[testID].data[i]);
             // printf("Sync Result: %s\n", result.c_str());
         }
 
@@ -204,6 +213,10 @@ void test(int threads)
 
         // printf("Loop Done\n");
     }
+
+    line.StopTrace();
+    line.WriteTrace("build/trace.bin");
+
     printf("Done Done\n");
 }
 
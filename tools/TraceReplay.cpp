@@ -0,0 +1,922 @@
+#include "AssemblyLineTrace.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <deque>
+#include <map>
+#include <queue>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <utility>
+
+// Offline tool for traces written by AssemblyLine::WriteTrace().
+// It reports the recorded stage costs, per thread busy/idle/lock time and the critical path, then replays the jobs
+// against a simulated thread pool so you can ask what-if questions, like a different thread count or cheaper stages.
+//
+// Usage -> trace_replay <trace file> [--threads [GROUP:]N]... [--lend GROUP=never|sync|idle]... [--scale LINE:TASK=FACTOR]... [--lock-scale FACTOR]
+//  --threads N        Sets the thread count of the default group 0, --threads 1:4 sets group 1 to 4 threads.
+//  --lend 1=never     Sets the LendPolicy of group 1.
+//
+// NOTE ->
+//  The simulation is deterministic, the same trace and options always give the same result.
+//  It models each worker group with its own queue's and threads, and uses the same sync/async priority, FIFO
+//  and lending rules as the engine. The mutex is modeled as a single resource held for the measured average
+//  lock time each time a task runs.
+
+struct Trace
+{
+    std::vector<int32_t> thread_groups;
+    std::vector<int32_t> group_policies;
+    std::vector<TraceEvent> events;
+};
+
+struct JobRecord
+{
+    int line_id = -1;
+    int group_id = 0;
+    bool is_async = false;
+    bool done = false;
+    std::vector<double> stage_ns; // Cost of each task in the assembly line, indexed by task index.
+    std::vector<bool> stage_known;
+    uint64_t stage_start_ns = 0;
+    int first_task = 0; // First task seen in the trace, above 0 for jobs that were requeued before StartTrace().
+};
+
+struct ThreadStats
+{
+    double busy_ns = 0;
+    double idle_ns = 0;
+    double lock_ns = 0;
+    int stages = 0;
+};
+
+// One step of the main thread, the time between steps is the main thread's own work "adding to buffers, reading results".
+struct MainStep
+{
+    TraceEventType type;
+    int group_id; // The launched group, -1 when every group was launched.
+    uint64_t time_ns;
+    std::vector<uint32_t> jobs; // Jobs released by a launch.
+};
+
+struct Analysis
+{
+    std::map<uint32_t, JobRecord> jobs;
+    std::map<uint32_t, JobRecord> carried; // Jobs that were already queued when the trace started, they have no Enqueue event.
+    std::map<std::pair<int, int>, std::pair<int, double>> stage_costs; // (line, task) -> (count, total ns)
+    std::map<int, int> line_lengths;
+    std::vector<ThreadStats> threads;
+    std::vector<MainStep> steps;
+    uint64_t end_ns = 0;
+    double mean_lock_ns = 0;
+};
+
+struct SimResult
+{
+    double makespan_ns = 0;
+    double sync_ns = 0;
+    double busy_ns = 0;
+    double idle_ns = 0;
+    double lock_ns = 0;
+    std::map<int, double> group_sync_ns; // Sync launch time by the launched group, -1 when every group was launched.
+    int unfinished = 0;
+};
+
+bool readTrace(const char *path, Trace &trace)
+{
+    FILE *file = fopen(path, "rb");
+
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    TraceHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1
+        && memcmp(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) == 0
+        && header.version == TRACE_VERSION;
+
+    if (ok)
+    {
+        trace.thread_groups.resize(header.thread_count);
+        trace.group_policies.resize(header.group_count);
+        trace.events.resize(header.event_count);
+
+        ok = fread(trace.thread_groups.data(), sizeof(int32_t), header.thread_count, file) == header.thread_count
+            && fread(trace.group_policies.data(), sizeof(int32_t), header.group_count, file) == header.group_count
+            && fread(trace.events.data(), sizeof(TraceEvent), header.event_count, file) == header.event_count;
+    }
+
+    // The group ids index the worker groups, a corrupt file must not be able to index past them.
+    for (size_t i = 0; ok && i < trace.thread_groups.size(); i++)
+    {
+        ok = trace.thread_groups[i] >= 0 && trace.thread_groups[i] < (int32_t)trace.group_policies.size();
+    }
+
+    fclose(file);
+    return ok;
+}
+
+void analyse(const Trace &trace, Analysis &analysis)
+{
+    analysis.threads.resize(trace.thread_groups.size());
+
+    for (const TraceEvent &event : trace.events)
+    {
+        analysis.end_ns = std::max(analysis.end_ns, event.time_ns);
+    }
+
+    // Per thread intervals, each thread's events are in time order in the file.
+    std::vector<uint64_t> lock_since(trace.thread_groups.size(), 0);
+    std::vector<uint64_t> sleep_since(trace.thread_groups.size(), 0);
+    std::vector<bool> holding(trace.thread_groups.size(), false);
+    std::vector<bool> sleeping(trace.thread_groups.size(), false);
+    std::vector<uint64_t> stage_since(trace.thread_groups.size(), 0);
+    std::vector<bool> running(trace.thread_groups.size(), false);
+    int lock_sections = 0;
+    double lock_total = 0;
+
+    for (const TraceEvent &event : trace.events)
+    {
+        if (event.thread_id < 0 || event.thread_id >= (int)analysis.threads.size())
+        {
+            continue;
+        }
+
+        int id = event.thread_id;
+        ThreadStats &stats = analysis.threads[id];
+
+        switch (event.type)
+        {
+            case TraceEventType::LockAcquired:
+            case TraceEventType::Wake:
+                if (event.type == TraceEventType::Wake && sleeping[id])
+                {
+                    stats.idle_ns += event.time_ns - sleep_since[id];
+                    sleeping[id] = false;
+                }
+                holding[id] = true;
+                lock_since[id] = event.time_ns;
+                break;
+            case TraceEventType::LockReleased:
+            case TraceEventType::Sleep:
+                if (holding[id])
+                {
+                    stats.lock_ns += event.time_ns - lock_since[id];
+                    holding[id] = false;
+                }
+                if (event.type == TraceEventType::Sleep)
+                {
+                    sleeping[id] = true;
+                    sleep_since[id] = event.time_ns;
+                }
+                break;
+            case TraceEventType::Dequeue:
+                stats.stages++;
+                break;
+            // Jobs of one batch share a single start and end, only the first of each is counted.
+            case TraceEventType::StageStart:
+                if (!running[id])
+                {
+                    running[id] = true;
+                    stage_since[id] = event.time_ns;
+                }
+                break;
+            case TraceEventType::StageEnd:
+                if (running[id])
+                {
+                    stats.busy_ns += event.time_ns - stage_since[id];
+                    running[id] = false;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    for (size_t i = 0; i < analysis.threads.size(); i++)
+    {
+        if (sleeping[i])
+        {
+            analysis.threads[i].idle_ns += analysis.end_ns - sleep_since[i];
+        }
+
+        lock_total += analysis.threads[i].lock_ns;
+        lock_sections += analysis.threads[i].stages;
+    }
+
+    analysis.mean_lock_ns = lock_sections > 0 ? lock_total / lock_sections : 0;
+
+    // Jobs and the main thread's timeline, the events are sorted by time so a job's events are seen in order.
+    std::vector<TraceEvent> sorted = trace.events;
+    std::stable_sort(sorted.begin(), sorted.end(), [](const TraceEvent &a, const TraceEvent &b) {
+        return a.time_ns < b.time_ns;
+    });
+
+    std::map<int, std::vector<uint32_t>> sync_pending; // Staged sync jobs by group, a launch can release one group or all of them.
+    std::vector<uint32_t> async_pending;
+
+    for (const TraceEvent &event : sorted)
+    {
+        if (event.task_index >= 0)
+        {
+            int &length = analysis.line_lengths[event.line_id];
+            length = std::max(length, event.task_index + 1);
+        }
+
+        if (event.thread_id == -1)
+        {
+            if (event.type == TraceEventType::Enqueue)
+            {
+                JobRecord &job = analysis.jobs[event.job_id];
+                job.line_id = event.line_id;
+                job.group_id = event.group_id;
+                job.is_async = event.is_async;
+
+                if (event.is_async)
+                {
+                    async_pending.push_back(event.job_id);
+                }
+                else
+                {
+                    sync_pending[event.group_id].push_back(event.job_id);
+                }
+                continue;
+            }
+
+            MainStep step;
+            step.type = event.type;
+            step.group_id = event.group_id;
+            step.time_ns = event.time_ns;
+
+            if (event.type == TraceEventType::LaunchSync)
+            {
+                for (auto &pending : sync_pending)
+                {
+                    if (event.group_id == -1 || event.group_id == pending.first)
+                    {
+                        step.jobs.insert(step.jobs.end(), pending.second.begin(), pending.second.end());
+                        pending.second.clear();
+                    }
+                }
+            }
+            else if (event.type == TraceEventType::LaunchAsync)
+            {
+                step.jobs.swap(async_pending);
+            }
+
+            analysis.steps.push_back(step);
+            continue;
+        }
+
+        if (event.job_id == 0)
+        {
+            continue;
+        }
+
+        // Jobs added to a buffer before StartTrace() have no Enqueue event, they are left out of the replay
+        // but there remaining work still counts towards the critical path.
+        auto found = analysis.jobs.find(event.job_id);
+
+        if (found == analysis.jobs.end())
+        {
+            auto carried = analysis.carried.emplace(event.job_id, JobRecord());
+            found = carried.first;
+
+            if (carried.second)
+            {
+                found->second.line_id = event.line_id;
+                found->second.group_id = event.group_id;
+                found->second.is_async = event.is_async;
+                found->second.first_task = std::max(0, (int)event.task_index);
+            }
+        }
+
+        JobRecord &job = found->second;
+
+        if (event.type == TraceEventType::StageStart)
+        {
+            job.stage_start_ns = event.time_ns;
+        }
+        else if (event.type == TraceEventType::StageEnd)
+        {
+            // Jobs run together by a BatchTask share the cost of the batch.
+            double cost = double(event.time_ns - job.stage_start_ns) / std::max(1, event.batch_size);
+
+            if ((int)job.stage_ns.size() <= event.task_index)
+            {
+                job.stage_ns.resize(event.task_index + 1, 0);
+                job.stage_known.resize(event.task_index + 1, false);
+            }
+
+            job.stage_ns[event.task_index] = cost;
+            job.stage_known[event.task_index] = true;
+
+            std::pair<int, double> &stage = analysis.stage_costs[{event.line_id, event.task_index}];
+            stage.first++;
+            stage.second += cost;
+        }
+        else if (event.type == TraceEventType::Complete)
+        {
+            job.done = true;
+        }
+    }
+
+    // Unfinished jobs use the average cost of there remaining tasks.
+    for (std::map<uint32_t, JobRecord> *records : {&analysis.jobs, &analysis.carried})
+    {
+        for (auto &entry : *records)
+        {
+            JobRecord &job = entry.second;
+
+            if (job.done)
+            {
+                continue;
+            }
+
+            int length = analysis.line_lengths[job.line_id];
+            job.stage_ns.resize(length, 0);
+            job.stage_known.resize(length, false);
+
+            for (int i = job.first_task; i < length; i++)
+            {
+                auto stage = analysis.stage_costs.find({job.line_id, i});
+
+                if (!job.stage_known[i] && stage != analysis.stage_costs.end())
+                {
+                    job.stage_ns[i] = stage->second.second / stage->second.first;
+                }
+            }
+        }
+    }
+}
+
+double jobCost(const JobRecord &job, const std::map<std::pair<int, int>, double> &scales, int task_index)
+{
+    auto scale = scales.find({job.line_id, task_index});
+    return job.stage_ns[task_index] * (scale == scales.end() ? 1.0 : scale->second);
+}
+
+double chainCost(const JobRecord &job, const std::map<std::pair<int, int>, double> &scales)
+{
+    double total = 0;
+
+    for (size_t i = 0; i < job.stage_ns.size(); i++)
+    {
+        total += jobCost(job, scales, i);
+    }
+
+    return total;
+}
+
+// The shortest possible run with unlimited threads and a free mutex.
+// The main thread's path is its own work plus the longest job of each sync launch, async jobs run alongside it
+// and can finish after it, so the result is the latest of the main thread's path and every async job's finish.
+// NOTE -> A job's chain includes every task that is requeued after its launch, jobs that were already queued
+//  when the trace started begin at time 0 with there remaining tasks.
+double criticalPath(const Analysis &analysis, const std::map<std::pair<int, int>, double> &scales)
+{
+    double total = 0;
+    double latest = 0;
+    uint64_t previous_ns = 0;
+    double longest_chain = 0;
+
+    for (const auto &entry : analysis.carried)
+    {
+        latest = std::max(latest, chainCost(entry.second, scales));
+    }
+
+    for (const MainStep &step : analysis.steps)
+    {
+        if (step.type == TraceEventType::SyncDone)
+        {
+            total += longest_chain;
+            longest_chain = 0;
+        }
+        else
+        {
+            total += step.time_ns - previous_ns;
+        }
+
+        if (step.type == TraceEventType::LaunchSync)
+        {
+            for (uint32_t job_id : step.jobs)
+            {
+                longest_chain = std::max(longest_chain, chainCost(analysis.jobs.at(job_id), scales));
+            }
+        }
+        else if (step.type == TraceEventType::LaunchAsync)
+        {
+            for (uint32_t job_id : step.jobs)
+            {
+                latest = std::max(latest, total + chainCost(analysis.jobs.at(job_id), scales));
+            }
+        }
+
+        previous_ns = step.time_ns;
+    }
+
+    return std::max(total, latest);
+}
+
+// Matches the LendPolicy enum in AssemblyLine.h, the trace stores each group's policy as its int value.
+enum SimLendPolicy
+{
+    LEND_NEVER = 0,
+    LEND_SYNC_ONLY = 1,
+    LEND_WHEN_IDLE = 2
+};
+
+struct SimConfig
+{
+    std::vector<int> group_threads;  // Thread count of each worker group.
+    std::vector<int> group_policies; // SimLendPolicy of each worker group.
+    std::map<std::pair<int, int>, double> scales;
+    double lock_scale = 1.0;
+};
+
+bool canLend(const SimConfig &config, int lender_id, int group_id, bool is_async)
+{
+    if (lender_id == group_id)
+    {
+        return false;
+    }
+
+    switch (config.group_policies[lender_id])
+    {
+        case LEND_NEVER:
+            return false;
+        case LEND_SYNC_ONLY:
+            return !is_async;
+        default:
+            return true;
+    }
+}
+
+SimResult simulate(const Analysis &analysis, const SimConfig &config)
+{
+    struct SimJob
+    {
+        uint32_t job_id;
+        int task_index;
+    };
+
+    struct SimGroup
+    {
+        std::deque<SimJob> sync_queue;
+        std::deque<SimJob> async_queue;
+        std::vector<int> idle_workers;
+    };
+
+    struct Worker
+    {
+        int group_id = 0;
+        bool busy = false;
+        double idle_since = 0;
+        SimJob job;
+    };
+
+    SimResult result;
+
+    int group_count = config.group_threads.size();
+    std::vector<SimGroup> groups(group_count);
+    std::vector<Worker> workers;
+
+    // Min heap of (time, worker) for the next time each running worker finishes a task.
+    using Event = std::pair<double, int>;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> running;
+
+    double lock_hold = analysis.mean_lock_ns * config.lock_scale;
+    double mutex_free = 0;
+    double main_time = 0;
+    double sync_launch_time = 0;
+    double sync_finish_time = 0;
+    int sync_outstanding = 0;
+    size_t step = 0;
+
+    for (int g = 0; g < group_count; g++)
+    {
+        for (int i = 0; i < config.group_threads[g]; i++)
+        {
+            Worker worker;
+            worker.group_id = g;
+            groups[g].idle_workers.push_back(workers.size());
+            workers.push_back(worker);
+        }
+    }
+
+    // Jobs from groups that do not exist in the config are run by the default group.
+    auto jobGroup = [&](const JobRecord &job) {
+        return job.group_id >= 0 && job.group_id < group_count ? job.group_id : 0;
+    };
+
+    // Wakes an idle thread for a new job, the group's own threads first and then threads of groups that lend to it.
+    auto wakeWorker = [&](double now, int group_id, bool is_async) {
+        for (int g = -1; g < group_count; g++)
+        {
+            int lender = g == -1 ? group_id : g;
+
+            if (g != -1 && !canLend(config, lender, group_id, is_async))
+            {
+                continue;
+            }
+
+            std::vector<int> &idle = groups[lender].idle_workers;
+
+            if (!idle.empty())
+            {
+                int id = idle.back();
+                idle.pop_back();
+                result.idle_ns += now - workers[id].idle_since;
+                running.push({now, id});
+                return;
+            }
+        }
+    };
+
+    // Same order as the engine, own sync, other groups sync, own async, other groups async.
+    auto pickQueue = [&](int home) -> std::deque<SimJob>* {
+        if (!groups[home].sync_queue.empty())
+        {
+            return &groups[home].sync_queue;
+        }
+
+        for (int g = 0; g < group_count; g++)
+        {
+            if (!groups[g].sync_queue.empty() && canLend(config, home, g, false))
+            {
+                return &groups[g].sync_queue;
+            }
+        }
+
+        if (!groups[home].async_queue.empty())
+        {
+            return &groups[home].async_queue;
+        }
+
+        for (int g = 0; g < group_count; g++)
+        {
+            if (!groups[g].async_queue.empty() && canLend(config, home, g, true))
+            {
+                return &groups[g].async_queue;
+            }
+        }
+
+        return nullptr;
+    };
+
+    while (true)
+    {
+        // The next time the main thread acts, a SyncDone step waits until every launched sync job is finished.
+        double main_next = -1;
+
+        if (step < analysis.steps.size())
+        {
+            const MainStep &next = analysis.steps[step];
+
+            if (next.type == TraceEventType::SyncDone)
+            {
+                main_next = sync_outstanding == 0 ? std::max(main_time, sync_finish_time) : -1;
+            }
+            else
+            {
+                uint64_t previous_ns = step > 0 ? analysis.steps[step - 1].time_ns : 0;
+                main_next = main_time + (next.time_ns - previous_ns);
+            }
+        }
+
+        if (main_next < 0 && running.empty())
+        {
+            break;
+        }
+
+        if (main_next >= 0 && (running.empty() || main_next <= running.top().first))
+        {
+            const MainStep &next = analysis.steps[step];
+            main_time = main_next;
+
+            if (next.type == TraceEventType::LaunchSync || next.type == TraceEventType::LaunchAsync)
+            {
+                bool is_async = next.type == TraceEventType::LaunchAsync;
+
+                for (uint32_t job_id : next.jobs)
+                {
+                    const JobRecord &job = analysis.jobs.at(job_id);
+
+                    if (job.stage_ns.empty())
+                    {
+                        continue;
+                    }
+
+                    SimGroup &group = groups[jobGroup(job)];
+                    (is_async ? group.async_queue : group.sync_queue).push_back({job_id, 0});
+                    wakeWorker(main_time, jobGroup(job), is_async);
+
+                    if (!is_async)
+                    {
+                        sync_outstanding++;
+                    }
+                }
+
+                if (!is_async)
+                {
+                    sync_launch_time = main_time;
+                    sync_finish_time = main_time;
+                }
+            }
+            else if (next.type == TraceEventType::SyncDone)
+            {
+                result.sync_ns += main_time - sync_launch_time;
+                result.group_sync_ns[next.group_id] += main_time - sync_launch_time;
+            }
+
+            result.makespan_ns = std::max(result.makespan_ns, main_time);
+            step++;
+            continue;
+        }
+
+        double now = running.top().first;
+        int id = running.top().second;
+        running.pop();
+
+        Worker &worker = workers[id];
+        result.makespan_ns = std::max(result.makespan_ns, now);
+
+        // Finish the worker's last task, the next task goes to the front of the queue just like the engine.
+        if (worker.busy)
+        {
+            const JobRecord &job = analysis.jobs.at(worker.job.job_id);
+            worker.busy = false;
+
+            if (worker.job.task_index + 1 < (int)job.stage_ns.size())
+            {
+                SimGroup &group = groups[jobGroup(job)];
+                (job.is_async ? group.async_queue : group.sync_queue).push_front({worker.job.job_id, worker.job.task_index + 1});
+                wakeWorker(now, jobGroup(job), job.is_async);
+            }
+            else if (!job.is_async)
+            {
+                sync_outstanding--;
+                sync_finish_time = now;
+            }
+        }
+
+        std::deque<SimJob> *queue = pickQueue(worker.group_id);
+
+        if (queue == nullptr)
+        {
+            worker.idle_since = now;
+            groups[worker.group_id].idle_workers.push_back(id);
+            continue;
+        }
+
+        worker.job = queue->front();
+        worker.busy = true;
+        queue->pop_front();
+
+        double acquired = std::max(now, mutex_free);
+        double cost = jobCost(analysis.jobs.at(worker.job.job_id), config.scales, worker.job.task_index);
+        mutex_free = acquired + lock_hold;
+
+        result.lock_ns += (acquired - now) + lock_hold;
+        result.busy_ns += cost;
+        running.push({acquired + lock_hold + cost, id});
+    }
+
+    for (const SimGroup &group : groups)
+    {
+        for (int id : group.idle_workers)
+        {
+            result.idle_ns += result.makespan_ns - workers[id].idle_since;
+        }
+
+        result.unfinished += group.sync_queue.size() + group.async_queue.size();
+    }
+
+    return result;
+}
+
+const char *policyName(int policy)
+{
+    switch (policy)
+    {
+        case LEND_NEVER:
+            return "never";
+        case LEND_SYNC_ONLY:
+            return "sync";
+        default:
+            return "idle";
+    }
+}
+
+void printSimulation(const char *title, const SimResult &result, const SimConfig &config)
+{
+    printf("%s\n", title);
+    printf("  groups:           ");
+
+    for (size_t g = 0; g < config.group_threads.size(); g++)
+    {
+        printf(" %zu=%d threads/%s", g, config.group_threads[g], policyName(config.group_policies[g]));
+    }
+
+    printf("\n");
+    printf("  makespan:          %12.3f ms\n", result.makespan_ns / 1e6);
+    printf("  sync launches:     %12.3f ms\n", result.sync_ns / 1e6);
+
+    for (const auto &group : result.group_sync_ns)
+    {
+        if (group.first == -1)
+        {
+            printf("    all groups:      %12.3f ms\n", group.second / 1e6);
+        }
+        else
+        {
+            printf("    group %-3d        %12.3f ms\n", group.first, group.second / 1e6);
+        }
+    }
+
+    printf("  thread busy:       %12.3f ms\n", result.busy_ns / 1e6);
+    printf("  thread idle:       %12.3f ms\n", result.idle_ns / 1e6);
+    printf("  lock wait + hold:  %12.3f ms\n", result.lock_ns / 1e6);
+
+    if (result.unfinished > 0)
+    {
+        printf("  NOTE -> %d tasks were never run, a group has no threads and no other group lends to it.\n", result.unfinished);
+    }
+}
+
+int usage()
+{
+    printf("Usage: trace_replay <trace file> [--threads [GROUP:]N]... [--lend GROUP=never|sync|idle]... [--scale LINE:TASK=FACTOR]... [--lock-scale FACTOR]\n");
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        return usage();
+    }
+
+    std::map<int, int> thread_overrides;
+    std::map<int, int> policy_overrides;
+    SimConfig what_if;
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            int group_id = 0;
+            int threads;
+            const char *value = argv[++i];
+
+            if (strchr(value, ':') != nullptr ? sscanf(value, "%d:%d", &group_id, &threads) != 2 : sscanf(value, "%d", &threads) != 1)
+            {
+                return usage();
+            }
+
+            // A group with 0 threads is allowed, its jobs are only run by groups that lend to it.
+            if (threads < 0)
+            {
+                printf("Thread count can not be negative: %d\n", threads);
+                return 1;
+            }
+
+            thread_overrides[group_id] = threads;
+        }
+        else if (strcmp(argv[i], "--lend") == 0 && i + 1 < argc)
+        {
+            int group_id;
+            char name[16];
+
+            if (sscanf(argv[++i], "%d=%15s", &group_id, name) != 2)
+            {
+                return usage();
+            }
+
+            if (strcmp(name, "never") == 0)
+            {
+                policy_overrides[group_id] = LEND_NEVER;
+            }
+            else if (strcmp(name, "sync") == 0)
+            {
+                policy_overrides[group_id] = LEND_SYNC_ONLY;
+            }
+            else if (strcmp(name, "idle") == 0)
+            {
+                policy_overrides[group_id] = LEND_WHEN_IDLE;
+            }
+            else
+            {
+                return usage();
+            }
+        }
+        else if (strcmp(argv[i], "--lock-scale") == 0 && i + 1 < argc)
+        {
+            what_if.lock_scale = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc)
+        {
+            int line_id, task_index;
+            double factor;
+
+            if (sscanf(argv[++i], "%d:%d=%lf", &line_id, &task_index, &factor) != 3)
+            {
+                return usage();
+            }
+
+            what_if.scales[{line_id, task_index}] = factor;
+        }
+        else
+        {
+            return usage();
+        }
+    }
+
+    Trace trace;
+
+    if (!readTrace(argv[1], trace))
+    {
+        printf("Could not read trace file, or it is not a valid trace: %s\n", argv[1]);
+        return 1;
+    }
+
+    Analysis analysis;
+    analyse(trace, analysis);
+
+    int recorded_threads = trace.thread_groups.size();
+    int groups = trace.group_policies.size();
+
+    // The recorded pool, each group's thread count and lend policy from the trace.
+    SimConfig recorded;
+    recorded.group_threads.resize(groups, 0);
+    recorded.group_policies.assign(trace.group_policies.begin(), trace.group_policies.end());
+
+    for (int32_t group_id : trace.thread_groups)
+    {
+        recorded.group_threads[group_id]++;
+    }
+
+    what_if.group_threads = recorded.group_threads;
+    what_if.group_policies = recorded.group_policies;
+
+    for (const auto &entry : thread_overrides)
+    {
+        if (entry.first < 0 || entry.first >= groups)
+        {
+            printf("Unknown worker group: %d\n", entry.first);
+            return 1;
+        }
+
+        what_if.group_threads[entry.first] = entry.second;
+    }
+
+    for (const auto &entry : policy_overrides)
+    {
+        if (entry.first < 0 || entry.first >= groups)
+        {
+            printf("Unknown worker group: %d\n", entry.first);
+            return 1;
+        }
+
+        what_if.group_policies[entry.first] = entry.second;
+    }
+
+    printf("Trace: %zu events, %d threads, %d worker groups, %zu jobs, %.3f ms\n\n",
+        trace.events.size(), recorded_threads, groups, analysis.jobs.size(), analysis.end_ns / 1e6);
+
+    printf("Stage costs\n");
+    printf("  %6s %6s %10s %14s %14s\n", "line", "task", "runs", "mean us", "total ms");
+
+    for (const auto &stage : analysis.stage_costs)
+    {
+        printf("  %6d %6d %10d %14.3f %14.3f\n", stage.first.first, stage.first.second, stage.second.first,
+            stage.second.second / stage.second.first / 1e3, stage.second.second / 1e6);
+    }
+
+    printf("\nThreads\n");
+    printf("  %6s %6s %10s %14s %14s %14s\n", "thread", "group", "tasks", "busy ms", "idle ms", "lock ms");
+
+    for (size_t i = 0; i < analysis.threads.size(); i++)
+    {
+        const ThreadStats &stats = analysis.threads[i];
+        printf("  %6zu %6d %10d %14.3f %14.3f %14.3f\n", i, trace.thread_groups[i], stats.stages, stats.busy_ns / 1e6, stats.idle_ns / 1e6, stats.lock_ns / 1e6);
+    }
+
+    printf("\nCritical path \"unlimited threads, free mutex\": %.3f ms\n", criticalPath(analysis, {}) / 1e6);
+    printf("Average lock hold per task: %.3f us\n\n", analysis.mean_lock_ns / 1e3);
+
+    printSimulation("Replay as recorded", simulate(analysis, recorded), recorded);
+
+    if (!thread_overrides.empty() || !policy_overrides.empty() || !what_if.scales.empty() || what_if.lock_scale != 1.0)
+    {
+        printf("\n");
+        printSimulation("What if", simulate(analysis, what_if), what_if);
+        printf("  critical path:     %12.3f ms\n", criticalPath(analysis, what_if.scales) / 1e6);
+    }
+
+    return 0;
+}